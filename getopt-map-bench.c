@@ -0,0 +1,283 @@
+/* getopt-map-bench.c
+ *
+ * Startup cost of the option tables: dynamic relocations of the image
+ * and the state of the pages holding the tables. The same option set is
+ * built either as the classic struct option / struct option_map vectors
+ * (absolute pointers, one relocation per string) or, with -DBENCH_POOL,
+ * as a pooled table (see _opt_pool_ on getopt-map.h).
+ *
+ * The memory figures are those of /proc/self/smaps for the mapping that
+ * holds the tables, measured while a second instance of the program is
+ * running: pages both instances share from the executable file show up
+ * as Shared_Clean, pages each one had to write (relocate) as Private_Dirty.
+ * Compare both as PIE executables:
+ *
+ * gcc -O2 -fPIE -pie -DGETOPT_MAP_EXTENSIONS -o bench -I. getopt-map.c getopt-map-bench.c
+ * gcc -O2 -fPIE -pie -DGETOPT_MAP_EXTENSIONS -DBENCH_POOL -o bench-pool -I. getopt-map.c getopt-map-bench.c
+ *
+ * sync; ./bench --threads=8 -v --port 80 && ./bench-pool --threads=8 -v --port 80
+ *
+ * (sync first: the page cache of a binary just written is still dirty.)
+ */
+#include <getopt-map.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <link.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+enum option_id {
+    _id_default_header_
+
+    _id_( verbose ),
+    _id_( quiet ),
+    _id_( config ),
+    _id_( log_file ),
+    _id_( log_level ),
+    _id_( threads ),
+    _id_( pool_size ),
+    _id_( listen ),
+    _id_( port ),
+    _id_( backlog ),
+    _id_( timeout ),
+    _id_( retries ),
+    _id_( cache_dir ),
+    _id_( cache_size ),
+    _id_( user ),
+    _id_( group ),
+    _id_( pid_file ),
+    _id_( daemon ),
+    _id_( chroot ),
+    _id_( tls_cert ),
+    _id_( tls_key ),
+    _id_( tls_ciphers ),
+    _id_( max_conns ),
+    _id_( help ),
+
+    _id_default_footer_
+};
+
+#define bench_opts(_opt_, _oph_)                \
+    _opt_( verbose, no )                        \
+    _opt_( quiet, no )                          \
+    _opt_( config, required )                   \
+    _opt_( log_file, required )                 \
+    _oph_( log_file, "log-file", required )     \
+    _opt_( log_level, optional )                \
+    _opt_( threads, required )                  \
+    _opt_( pool_size, required )                \
+    _opt_( listen, required )                   \
+    _opt_( port, required )                     \
+    _opt_( backlog, required )                  \
+    _opt_( timeout, required )                  \
+    _opt_( retries, required )                  \
+    _opt_( cache_dir, required )                \
+    _opt_( cache_size, required )               \
+    _opt_( user, required )                     \
+    _opt_( group, required )                    \
+    _opt_( pid_file, required )                 \
+    _opt_( daemon, no )                         \
+    _opt_( chroot, required )                   \
+    _opt_( tls_cert, required )                 \
+    _opt_( tls_key, required )                  \
+    _opt_( tls_ciphers, required )              \
+    _opt_( max_conns, required )                \
+    _opt_( help, no )
+
+#define bench_maps(_opt_map_)                                                   \
+    _opt_map_( 0,           'V', "Print the version and exit")                  \
+    _opt_map_( verbose,     'v', "Increase the verbosity")                      \
+    _opt_map_( quiet,       'q', "Only report errors")                          \
+    _opt_map_( config,      'c', "Read the configuration from file")            \
+    _opt_map_( log_file,    'l', "Write the log to file")                       \
+    _opt_map_( log_level,     0, "Log level (default: info)")                   \
+    _opt_map_( threads,     't', "Number of worker threads")                    \
+    _opt_map_( pool_size,     0, "Size of the buffer pool")                     \
+    _opt_map_( listen,        0, "Address to listen on")                        \
+    _opt_map_( port,        'p', "Port to listen on")                           \
+    _opt_map_( backlog,       0, "Length of the listen queue")                  \
+    _opt_map_( timeout,       0, "Idle connection timeout")                     \
+    _opt_map_( retries,       0, "Retries before giving up")                    \
+    _opt_map_( cache_dir,     0, "Cache directory")                             \
+    _opt_map_( cache_size,    0, "Cache size limit")                            \
+    _opt_map_( user,        'u', "Run as user")                                 \
+    _opt_map_( group,       'g', "Run as group")                                \
+    _opt_map_( pid_file,      0, "Write the process id to file")                \
+    _opt_map_( daemon,      'd', "Detach from the terminal")                    \
+    _opt_map_( chroot,        0, "Change the root directory")                   \
+    _opt_map_( tls_cert,      0, "TLS certificate")                             \
+    _opt_map_( tls_key,       0, "TLS private key")                             \
+    _opt_map_( tls_ciphers,   0, "TLS cipher list")                             \
+    _opt_map_( max_conns,     0, "Maximum number of connections")               \
+    _opt_map_( help,        'h', "Display this help and exit")
+
+#ifdef BENCH_POOL
+static _opt_pool_( bench_pool, bench_opts, bench_maps );
+#define bench_map(id)     getopt_pool_map (_pool_( bench_pool ), id)
+#define bench_msg(id)     getopt_pool_msg (_pool_( bench_pool ), id)
+#else
+struct option long_opts[] = {
+    _opt_default_header_ bench_opts( _opt_list_, _oph_list_ ) _opt_default_footer_
+};
+
+struct option_map opts_maps[] = {
+    _opt_map_default_header_ bench_maps( _opt_map_list_ ) _opt_map_default_footer_
+};
+#define bench_msg(id)     getopt_msg (opts_maps, id)
+
+// Short char mapped to <id>, through option_map_p as getopt_map does not
+// return for ids in range
+static int bench_map (int id)
+{
+  struct option_map *m = option_map_p (opts_maps, id);
+
+  return m ? m->ch : 0;
+}
+#endif
+
+// Dynamic relocations of the executable (RELR packed ones are reported in bytes)
+static void relocations (long *rel, long *relative, long *relr)
+{
+  ElfW(Dyn) *d;
+  long sz = 0, ent = 0, cnt = 0;
+
+  *rel = *relative = *relr = 0;
+  for (d = _DYNAMIC ; d->d_tag != DT_NULL ; d++)
+    switch (d->d_tag) {
+    case DT_RELASZ: case DT_RELSZ:         sz  += d->d_un.d_val; break;
+    case DT_RELAENT: case DT_RELENT:       ent  = d->d_un.d_val; break;
+    case DT_RELACOUNT: case DT_RELCOUNT:   cnt += d->d_un.d_val; break;
+#ifdef DT_RELRSZ
+    case DT_RELRSZ:                        *relr += d->d_un.d_val; break;
+#endif
+    }
+  *rel = ent ? sz / ent : 0;
+  *relative = cnt;
+}
+
+struct mapping {
+    char perms[8];
+    long rss, shared_clean, private_clean, shared_dirty, private_dirty;   // kB
+};
+
+// smaps figures of the mapping holding <addr>
+static int mapping (const void *addr, struct mapping *m)
+{
+  unsigned long lo, hi, a = (unsigned long) addr;
+  char line[512], perms[8];
+  int in = 0;
+  FILE *f;
+
+  memset (m, 0, sizeof (*m));
+  if ((f = fopen ("/proc/self/smaps", "r")) == NULL)
+    return -1;
+  while (fgets (line, sizeof (line), f)) {
+    if (sscanf (line, "%lx-%lx %7s", &lo, &hi, perms) == 3) {
+      if (in)
+        break;
+      if ((in = a >= lo && a < hi))
+        strcpy (m->perms, perms);
+    }
+    else if (in) {
+      sscanf (line, "Rss: %ld", &m->rss);
+      sscanf (line, "Shared_Clean: %ld", &m->shared_clean);
+      sscanf (line, "Private_Clean: %ld", &m->private_clean);
+      sscanf (line, "Shared_Dirty: %ld", &m->shared_dirty);
+      sscanf (line, "Private_Dirty: %ld", &m->private_dirty);
+    }
+  }
+  fclose (f);
+  return in ? 0 : -1;
+}
+
+// Starts a second instance and waits until it has gone through its
+// tables. Closing the returned descriptor lets it exit.
+static int sibling (char *app)
+{
+  int sv[2];
+  char c;
+
+  if (socketpair (AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+    return -1;
+  if (fork () == 0) {
+    dup2 (sv[1], 0);
+    close (sv[0]);
+    close (sv[1]);
+    setenv ("BENCH_SIBLING", "1", 1);
+    execl ("/proc/self/exe", app, (char *) NULL);
+    _exit (1);
+  }
+  close (sv[1]);
+  if (read (sv[0], &c, 1) != 1) {
+    close (sv[0]);
+    return -1;
+  }
+  return sv[0];
+}
+
+int main (int ac, char *av[])
+{
+  char *short_opts = ":Vvqc:l:t:p:u:g:dh", c;
+  int opt, optidx, id, seen = 0, mapped = 0, sib = -1;
+  long rel, relative, relr;
+  struct option *lopts;
+  struct mapping m;
+  const void *tables;
+
+#ifdef BENCH_POOL
+  if ((lopts = getopt_pool_options (_pool_( bench_pool ))) == NULL)
+    exit (1);
+  tables = &bench_pool;
+#else
+  lopts = long_opts;
+  tables = opts_maps;
+#endif
+
+  while ((opt = getopt_long(ac, av, short_opts, lopts, &optidx)) != -1)
+    if (opt != '?' && opt != ':')
+      seen++;
+
+  // Touch every message and mapping, as a help screen would
+  for (id = _id_( _lim_inf ) + 1 ; id < _id_( _lim_sup_ ) && id <= _id_( help ) ; id++)
+    mapped += (bench_map (id) != 0) + (bench_msg (id) != NULL);
+  for (id = _id_( _lim_sup ) + 1 ; id < _id_( _lim_messages ) ; id++)
+    mapped += (bench_msg (id) != NULL);
+
+#ifdef BENCH_POOL
+  free (lopts);
+#endif
+
+  if (getenv ("BENCH_SIBLING")) {
+    // Ready, hold the pages until the first instance is done measuring
+    if (write (0, "r", 1) == 1)
+      while (read (0, &c, 1) > 0)
+        ;
+    exit (0);
+  }
+  sib = sibling (av[0]);
+
+  relocations (&rel, &relative, &relr);
+
+#ifdef BENCH_POOL
+  printf ("tables:           pool (%zu bytes, read only)\n", sizeof (bench_pool));
+#else
+  printf ("tables:           classic (%zu + %zu bytes, relocated)\n", sizeof (long_opts), sizeof (opts_maps));
+#endif
+  printf ("options parsed:   %d, entries looked up: %d\n", seen, mapped);
+  printf ("relocations:      %ld (%ld relative, %ld bytes relr)\n", rel, relative, relr);
+  if (mapping (tables, &m) == 0) {
+    printf ("tables mapping:   %s, rss %ld kB%s\n", m.perms, m.rss, sib < 0 ? " (no second instance)" : "");
+    printf ("  shared clean:   %ld kB\n", m.shared_clean);
+    printf ("  private clean:  %ld kB\n", m.private_clean);
+    printf ("  shared dirty:   %ld kB\n", m.shared_dirty);
+    printf ("  private dirty:  %ld kB\n", m.private_dirty);
+  }
+
+  if (sib >= 0) {
+    close (sib);
+    wait (NULL);
+  }
+  exit (0);
+}
@@ -0,0 +1,143 @@
+/* getopt-map-example3.c
+ *
+ * Parse once, share with the workers. The master parses the command
+ * line, records it on a snapshot and writes it to an unlinked temporary
+ * file. Each worker is exec'd with the file descriptor number on the
+ * environment and reads the options by _id_ straight from the mapped
+ * blob, without calling getopt_long again.
+ *
+ * Compile with -DGETOPT_MAP_EXTENSIONS -DGETOPT_MAP_SNAPSHOT.
+ */
+#include <getopt-map.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+enum option_id {
+    _id_default_header_
+
+    _id_( optional ),
+    _id_( required ),
+    _id_( flag ),
+    _id_( workers ),
+    _id_( help ),
+
+    _id_default_footer_
+};
+
+struct option long_opts[] = {
+    _opt_default_header_
+
+    _opt_( optional, optional),
+    _opt_( required, required),
+    _opt_( flag, no),
+    _opt_( workers, required),
+    _opt_( help, 0),
+
+    _opt_default_footer_
+};
+
+struct option_map opts_maps[] = {
+    _opt_map_default_header_
+
+    _opt_map_( 0,           'g', "Char only option with required argument"),
+    _opt_map_( optional,    'o', "Optional argument to option"),
+    _opt_map_( required,      0, "Required argument to option"),
+    _opt_map_( flag,        'F', "Takes no option"),
+    _opt_map_( workers,     'w', "Number of workers to spawn"),
+    _opt_map_( help,        'h', "Display this help and exit"),
+
+    _opt_map_default_footer_
+};
+
+#define myapp_version _stringify_(VERSION)
+#define myapp_license _stringify_(LICENSE)
+#define myapp_fd_env  "GETOPT_MAP_SNAPSHOT_FD"
+
+char *short_opts = ":o::g:Fw:h";
+
+static int worker (char *app, int fd)
+{
+  struct getopt_map_snapshot *s;
+  char *g, *optional, *required;
+
+  if ((s = getopt_map_snapshot_attach (fd, short_opts, long_opts, opts_maps)) == NULL) {
+    printf ("[%d] %s: stale or foreign snapshot\n", (int) getpid (), app);
+    return 1;
+  }
+  // NULL when not seen or seen without argument
+  g        = getopt_map_snapshot_get (s, 'g');
+  optional = getopt_map_snapshot_get (s, _id_( optional ));
+  required = getopt_map_snapshot_get (s, _id_( required ));
+
+  printf ("[%d] g = '%s', optional = '%s' (%d), required = '%s', flag = %d, workers = %ld\n", (int) getpid (),
+          g ? g : "", optional ? optional : "", getopt_map_snapshot_has (s, _id_( optional )),
+          required ? required : "", getopt_map_snapshot_has (s, _id_( flag )),
+          getopt_map_snapshot_get_long (s, _id_( workers ), 0));
+  getopt_map_snapshot_free (s);
+  return 0;
+}
+
+int main (int ac, char *av[])
+{
+  struct getopt_map_snapshot *s;
+  char *env, fdstr[16];
+  int opt, optidx, n, workers = 2;
+  FILE *f;
+
+  if ((env = getenv (myapp_fd_env)) != NULL)
+    return worker (av[0], atoi (env));
+
+  if ((s = getopt_map_snapshot_new (short_opts, long_opts, opts_maps)) == NULL)
+    exit (1);
+
+  while ((opt = getopt_long(ac, av, short_opts, long_opts, &optidx)) != -1) {
+    switch (opt) {
+    case 'g':
+    case _id_( optional ): case 'o':
+    case _id_( required ):
+    case _id_( flag ): case 'F':
+      getopt_map_snapshot_set (s, opt, optarg);
+      break;
+
+    case _id_( workers ): case 'w':
+      workers = atoi (optarg);
+      break;
+
+    case ':':
+      printf ("%s %s\n", getopt_msg (opts_maps, _id_( _arg_missing )), av[optind-1]);
+      getopt_usage (av[0], myapp_version, myapp_license, short_opts, long_opts, opts_maps, 1);
+
+    case '?':
+      printf ("%s %s\n", getopt_msg (opts_maps, _id_( _opt_unknown )), av[optind-1]);
+      getopt_usage (av[0], myapp_version, myapp_license, short_opts, long_opts, opts_maps, 1);
+
+    case _id_( help ): case 'h':
+      getopt_usage (av[0], myapp_version, myapp_license, short_opts, long_opts, opts_maps, 1);
+
+    default:
+      printf ("%s --%s (%d)\n", getopt_msg (opts_maps, _id_( _opt_unhandled )), long_opts[optidx].name, opt);
+    }
+  }
+
+  getopt_map_snapshot_set_long (s, _id_( workers ), workers);
+
+  // The descriptor of a tmpfile is inherited through exec
+  if ((f = tmpfile ()) == NULL || getopt_map_snapshot_write (fileno (f), s) < 0)
+    exit (1);
+  getopt_map_snapshot_free (s);
+
+  snprintf (fdstr, sizeof (fdstr), "%d", fileno (f));
+  setenv (myapp_fd_env, fdstr, 1);
+
+  for (n = 0 ; n < workers ; n++)
+    if (fork () == 0) {
+      execl ("/proc/self/exe", av[0], (char *) NULL);
+      exit (1);
+    }
+  while (wait (NULL) > 0)
+    ;
+
+  exit (0);
+}
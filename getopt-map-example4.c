@@ -0,0 +1,144 @@
+/* getopt-map-example4.c
+ *
+ * Deferred handlers. Nothing is done while the command line is parsed:
+ * getopt_deferred keeps the last value of each option and, only if all
+ * of them are valid, calls the handlers once each, in dependency order.
+ * Try, for example:
+ *
+ * ./example4 --pool=64 -t 2 --log=/dev/null -t 4 --log=/dev/stdout
+ * ./example4 --pool=64 -t 2 -z
+ */
+#include <getopt-map.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+enum option_id {
+    _id_default_header_
+
+    _id_( log ),
+    _id_( threads ),
+    _id_( pool ),
+    _id_( verbose ),
+    _id_( help ),
+
+    _id_default_footer_
+};
+
+struct option long_opts[] = {
+    _opt_default_header_
+
+    _opt_( log, required),
+    _opt_( threads, required),
+    _opt_( pool, required),
+    _opt_( verbose, no),
+    _opt_( help, 0),
+
+    _opt_default_footer_
+};
+
+struct option_map opts_maps[] = {
+    _opt_map_default_header_
+
+    _opt_map_( log,     'l', "Append the log to file"),
+    _opt_map_( threads, 't', "Number of worker threads"),
+    _opt_map_( pool,      0, "Buffers per thread"),
+    _opt_map_( verbose, 'v', "Report what is being set up"),
+    _opt_map_( help,    'h', "Display this help and exit"),
+
+    _opt_map_default_footer_
+};
+
+#define myapp_version _stringify_(VERSION)
+#define myapp_license _stringify_(LICENSE)
+
+struct app {
+    FILE *log;
+    int   threads;
+    int   buffers;
+};
+
+static int on_log (int id, char *arg, void *data)
+{
+  struct app *a = data;
+
+  if ((a->log = fopen (arg, "a")) == NULL)
+    return -1;
+  fprintf (a->log, "log = '%s'\n", arg);
+  return 0;
+}
+
+static int on_threads (int id, char *arg, void *data)
+{
+  struct app *a = data;
+
+  if ((a->threads = atoi (arg)) <= 0)
+    return -1;
+  fprintf (a->log, "threads = %d\n", a->threads);
+  return 0;
+}
+
+static int on_pool (int id, char *arg, void *data)
+{
+  struct app *a = data;
+
+  a->buffers = a->threads * atoi (arg);   // Sized after the threads are known
+  fprintf (a->log, "pool = %d buffers\n", a->buffers);
+  return 0;
+}
+
+static int on_verbose (int id, char *arg, void *data)
+{
+  struct app *a = data;
+
+  fprintf (a->log, "verbose\n");
+  return 0;
+}
+
+struct option_handler handlers[] = {
+    _opt_handler_default_header_
+
+    _opt_handler_( pool,    on_pool,    _id_( threads ), _id_( log ) ),
+    _opt_handler_( threads, on_threads, _id_( log ) ),
+    _opt_handler_( verbose, on_verbose, _id_( log ) ),
+    _opt_handler_( log,     on_log ),
+
+    _opt_handler_default_footer_
+};
+
+int main (int ac, char *av[])
+{
+  char *short_opts = ":l:t:vh";
+  struct app a = { stdout, 1, 0 };
+  struct option *o;
+  int ret, failed;
+
+  switch (ret = getopt_deferred (ac, av, short_opts, long_opts, opts_maps, handlers, &a, &failed)) {
+  case 0:
+    break;
+
+  case ':':
+    printf ("%s %s\n", getopt_msg (opts_maps, _id_( _arg_missing )), av[optind-1]);
+    getopt_usage (av[0], myapp_version, myapp_license, short_opts, long_opts, opts_maps, 1);
+
+  case '?':
+    printf ("%s %s\n", getopt_msg (opts_maps, _id_( _opt_unknown )), av[optind-1]);
+    getopt_usage (av[0], myapp_version, myapp_license, short_opts, long_opts, opts_maps, 1);
+
+  case _id_( help ): case 'h':
+    getopt_usage (av[0], myapp_version, myapp_license, short_opts, long_opts, opts_maps, 0);
+
+  default:
+    if (failed && (o = option_p (long_opts, failed)) != NULL)
+      printf ("%s --%s\n", getopt_msg (opts_maps, _id_( _arg_invalid )), o->name);
+    else if (failed)
+      printf ("%s -%c\n", getopt_msg (opts_maps, _id_( _arg_invalid )), failed);
+    else if (ret > 0)
+      printf ("%s %s\n", getopt_msg (opts_maps, _id_( _opt_unhandled )), av[optind-1]);
+    else
+      printf ("%s (%d)\n", getopt_msg (opts_maps, _id_( _app_error )), ret);
+    exit (1);
+  }
+
+  printf ("%d threads, %d buffers\n", a.threads, a.buffers);
+  exit (0);
+}
@@ -12,6 +12,12 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#if defined( GETOPT_MAP_EXTENSIONS ) && defined( GETOPT_MAP_SNAPSHOT )
+#include <stdint.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -79,14 +85,11 @@ char *getopt_msg (struct option_map *m, int id)
     return NULL;
 }
 
-void getopt_usage (char *app_name, char *app_version, char *app_license, 
-                   char *short_opts, struct option *long_opts,
-                   struct option_map *opts_maps, int exit_val)
+// Application information, returns the stripped application name
+static char *usage_app (char *app_name, char *app_version, char *app_license)
 {
-  char *app, *msg, *chr, *argobl, *argopt;
-  struct option *opt;
-  
-  // Application information
+  char *app = NULL;
+
   if (app_name) {
     app = strrchr (app_name, '/');     // Strip path
     app = (app == NULL) ? app_name : app + 1;
@@ -98,6 +101,43 @@ void getopt_usage (char *app_name, char *app_version, char *app_license,
       printf (" - (c).%s", app_license);
     printf ("\n");
   }
+  return app;
+}
+
+// One mapped option. <chr> is the short option char, pointing into the
+// short options string when there is no long option (<name> == NULL).
+static void usage_opt (const char *chr, const char *name, int has_arg, const char *msg,
+                       const char *argobl, const char *argopt)
+{
+  if (name || (chr && *chr)) {
+    printf ("    ");
+    
+    // Short (char) option?
+    if (chr && *chr)
+      printf ("-%c%s", *chr, name ? ", ": " ");
+
+    // Long option?
+    if (name)
+      printf ("--%s %s", name, 
+              has_arg != no_argument ? has_arg == required_argument ? argobl: argopt: "");
+    else if (chr && *chr)
+      printf ("%s", chr[1] == ':' ? chr[2] == ':' ? argopt: argobl: "");
+      
+    if (*msg)
+      printf("\n        %s\n", msg);
+    else
+      printf("\n");
+  }
+}
+
+void getopt_usage (char *app_name, char *app_version, char *app_license, 
+                   char *short_opts, struct option *long_opts,
+                   struct option_map *opts_maps, int exit_val)
+{
+  char *app, *msg, *chr, *argobl, *argopt;
+  struct option *opt;
+  
+  app = usage_app (app_name, app_version, app_license);
   
   if (opts_maps && (short_opts || long_opts)) {
     // Usage header information
@@ -123,34 +163,518 @@ void getopt_usage (char *app_name, char *app_version, char *app_license,
       else {
         opt = NULL;
         // Type of parameter availabe from <short_opts> string
-        chr = strchr (short_opts, opts_maps->ch);
+        chr = short_opts ? strchr (short_opts, opts_maps->ch) : NULL;
       }
       
-      if (opt || (chr && *chr)) {
-        printf ("    ");
-        
-        // Short (char) option?
-        if (chr && *chr)
-          printf ("-%c%s", *chr, opt ? ", ": " ");
-
-        // Long option?
-        if (opt)
-          printf ("--%s %s", opt->name, 
-                  opt->has_arg != no_argument ? opt->has_arg == required_argument ? argobl: argopt: "");
-        else if (chr && *chr)
-          printf ("%s", chr[1] == ':' ? chr[2] == ':' ? argopt: argobl: "");
-          
-        if (*opts_maps->msg)
-          printf("\n        %s\n", opts_maps->msg);
-        else
-          printf("\n");
-      }
+      usage_opt (chr, opt ? opt->name : NULL, opt ? opt->has_arg : no_argument, opts_maps->msg, argobl, argopt);
     }
     if ((msg = getopt_msg (opts_maps, _id_( _app_footer ))) != NULL)
       printf (msg, app);
   }
   exit (exit_val);
 }
+
+const struct option_pool *option_pool_p (const struct option_pool *p, int kind, int id)
+{
+  if (p == 0)
+    return NULL;
+
+  for ( ; p->kind != _pool_end ; p = _pool_next_(p))
+    if (p->id == id && p->kind == kind)
+      return p;
+  return NULL;
+}
+
+int getopt_pool_map (const struct option_pool *p, int id)
+{
+  if (id <= _id_( _lim_inf ) || id >= _id_( _lim_sup ) || (p = option_pool_p (p, _pool_map, id)) == NULL)
+    return 0;
+  return p->ch;
+}
+
+const char *getopt_pool_msg (const struct option_pool *p, int id)
+{
+  if (id == _id_( _zero ) || (p = option_pool_p (p, _pool_map, id)) == NULL || p->hidden)
+    return NULL;
+  return p->str;
+}
+
+struct option *getopt_pool_options (const struct option_pool *p)
+{
+  const struct option_pool *q;
+  struct option *opts, *o;
+  size_t n = 1;
+
+  if (p == 0)
+    return NULL;
+
+  for (q = p ; q->kind != _pool_end ; q = _pool_next_(q))
+    if (q->kind == _pool_opt)
+      n++;
+  if ((opts = o = calloc (n, sizeof (struct option))) == NULL)
+    return NULL;
+
+  // Names point into the pool, only the vector itself is written
+  for (q = p ; q->kind != _pool_end ; q = _pool_next_(q))
+    if (q->kind == _pool_opt) {
+      o->name    = q->str;
+      o->has_arg = q->has_arg;
+      o->val     = q->id;
+      o++;
+    }
+  return opts;
+}
+
+void getopt_pool_usage (char *app_name, char *app_version, char *app_license, 
+                        char *short_opts, const struct option_pool *pool, int exit_val)
+{
+  const struct option_pool *p, *opt;
+  const char *msg, *chr, *argobl, *argopt;
+  char *app;
+  
+  app = usage_app (app_name, app_version, app_license);
+  
+  if (pool) {
+    // Usage header information
+    if ((msg = getopt_pool_msg (pool, _id_( _app_header ))) != NULL)
+      printf (msg, app);
+
+    if ((argobl = getopt_pool_msg (pool, _id_( _arg_obligatory ))) == NULL)
+      argobl = "<...>";
+    if ((argopt = getopt_pool_msg (pool, _id_( _arg_optional ))) == NULL)
+      argopt = "[...]";
+
+    // Print mapped options
+    for (p = pool ; p->kind != _pool_end && p->id != _id_( _lim_sup ) ; p = _pool_next_(p)) {
+
+      if (p->kind != _pool_map || p->hidden)
+        continue;
+
+      if (p->id > _id_( _lim_inf )) {
+        opt = option_pool_p (pool, _pool_opt, p->id);
+        chr = &p->ch;
+      }
+      else {
+        opt = NULL;
+        chr = short_opts ? strchr (short_opts, p->ch) : NULL;
+      }
+
+      usage_opt (chr, opt ? opt->str : NULL, opt ? opt->has_arg : no_argument, p->str, argobl, argopt);
+    }
+    if ((msg = getopt_pool_msg (pool, _id_( _app_footer ))) != NULL)
+      printf (msg, app);
+  }
+  exit (exit_val);
+}
+
+// Long option id a short char is mapped to (the char itself if none)
+static int option_map_id (struct option_map *m, int ch)
+{
+  if (m && ch > 0 && ch <= UCHAR_MAX)
+    for ( ; m->id || m->ch || m->msg ; m++)
+      if ((unsigned char) m->ch == ch && m->id > _id_( _lim_inf ) && m->id < _id_( _lim_sup ))
+        return m->id;
+  return ch;
+}
+
+struct deferred {
+    char *arg;
+    char  seen;
+    char  state;     // 0 new, 1 ordering its dependencies, 2 ordered
+};
+
+static int deferred_find (struct option_handler *h, int n, int id)
+{
+  int i;
+
+  for (i = 0 ; i < n ; i++)
+    if (h[i].id == id)
+      return i;
+  return -1;
+}
+
+// Depth first, handlers land on <order> after the ones they depend on
+static int deferred_order (struct option_handler *h, int n, struct deferred *d, int *order, int *k, int i)
+{
+  int j, dep;
+
+  if (d[i].state == 2)
+    return 0;
+  if (d[i].state == 1)
+    return GETOPT_DEFERRED_CYCLE;
+
+  d[i].state = 1;
+  for (j = 0 ; j < GETOPT_HANDLER_DEPS && h[i].after[j] ; j++)
+    if ((dep = deferred_find (h, n, h[i].after[j])) >= 0 && deferred_order (h, n, d, order, k, dep) != 0)
+      return GETOPT_DEFERRED_CYCLE;
+  d[i].state = 2;
+  order[(*k)++] = i;
+  return 0;
+}
+
+int getopt_deferred (int ac, char *av[], char *short_opts, struct option *long_opts,
+                     struct option_map *maps, struct option_handler *h, void *data,
+                     int *failed)
+{
+  struct deferred *d;
+  int *order, n, i, k, opt, optidx, ret = 0;
+
+  if (failed)
+    *failed = 0;
+  if (h == 0)
+    return GETOPT_DEFERRED_ERROR;
+
+  for (n = 0 ; h[n].id || h[n].fn ; n++)
+    ;
+  d = calloc (n + 1, sizeof (*d));
+  order = malloc ((n + 1) * sizeof (*order));
+  if (d == NULL || order == NULL) {
+    ret = GETOPT_DEFERRED_ERROR;
+    goto out;
+  }
+
+  // Order is settled before anything runs
+  for (i = 0, k = 0 ; i < n ; i++)
+    if ((ret = deferred_order (h, n, d, order, &k, i)) != 0)
+      goto out;
+
+  // Only the last value of each option is kept
+  while ((opt = getopt_long (ac, av, short_opts, long_opts, &optidx)) != -1) {
+    if (opt == 0)        // Stored on *flag by getopt_long
+      continue;
+    if (opt == '?' || opt == ':' || opt == 1 ||
+        (i = deferred_find (h, n, option_map_id (maps, opt))) < 0) {
+      ret = opt;
+      goto out;
+    }
+    d[i].seen = 1;
+    d[i].arg  = optarg;
+  }
+
+  for (k = 0 ; k < n ; k++)
+    if (d[order[k]].seen && h[order[k]].fn &&
+        (ret = h[order[k]].fn (h[order[k]].id, d[order[k]].arg, data)) != 0) {
+      if (failed)
+        *failed = h[order[k]].id;
+      break;
+    }
+
+out:
+  free (order);
+  free (d);
+  return ret;
+}
+
+#ifdef GETOPT_MAP_SNAPSHOT
+/** Snapshot blob layout **
+ * [ header | slot[nslots] | string pool ], all references are offsets
+ * from the start of the blob. Slots 1..UCHAR_MAX hold short option chars,
+ * the following ones the long option ids above _lim_inf. Numbers are kept
+ * on the slot itself, strings on the pool.
+ */
+#define _snap_magic_     0x534d4f47  // "GOMS"
+#define _snap_version_   1
+#define _snap_chars_     (UCHAR_MAX + 1)
+
+enum snapshot_kind {
+    _snap_absent = 0,
+    _snap_flag,          // Seen without argument
+    _snap_string,        // Seen with argument, off -> string pool, v.l bytes kept
+    _snap_long,          // Seen with argument, converted by the master
+    _snap_double,        //
+    _snap_alias          // Short char folded into a long option, off -> slot
+};
+
+struct snapshot_slot {
+    uint8_t  kind;
+    uint8_t  pad;
+    uint16_t count;      // Times seen (saturated)
+    uint32_t off;
+    union {
+        int64_t l;
+        double  d;
+    } v;
+};
+
+struct snapshot_blob {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t hash;       // Of the option tables the blob belongs to
+    uint32_t nslots;
+    uint32_t size;       // Bytes in use, header included
+    uint32_t pad;
+    struct snapshot_slot slot[];
+};
+
+struct getopt_map_snapshot {
+    struct snapshot_blob *b;
+    size_t cap;          // Allocated bytes, 0 when attached (read only)
+    size_t len;          // Mapped bytes when attached
+};
+
+static uint32_t snapshot_hash (uint32_t h, const void *p, size_t n)
+{
+  const unsigned char *c = p;
+
+  while (n--)             // FNV-1a
+    h = (h ^ *c++) * 16777619u;
+  return h;
+}
+
+static uint32_t snapshot_tables (char *short_opts, struct option *o, struct option_map *m, uint32_t *nslots)
+{
+  uint32_t h = 2166136261u;
+  int top = _id_( _lim_inf );
+
+  if (short_opts)
+    h = snapshot_hash (h, short_opts, strlen (short_opts) + 1);
+  for ( ; o && o->val < _id_( _lim_sup ) && (o->val != _id_( _zero ) || o->name) ; o++) {
+    if (o->name)
+      h = snapshot_hash (h, o->name, strlen (o->name) + 1);
+    h = snapshot_hash (h, &o->has_arg, sizeof (o->has_arg));
+    h = snapshot_hash (h, &o->val, sizeof (o->val));
+    if (o->val > top && o->val < _id_( _lim_sup ))
+      top = o->val;
+  }
+  for ( ; m && (m->id || m->ch || m->msg) ; m++) {
+    h = snapshot_hash (h, &m->id, sizeof (m->id));
+    h = snapshot_hash (h, &m->ch, sizeof (m->ch));
+    if (m->id > top && m->id < _id_( _lim_sup ))
+      top = m->id;
+  }
+  *nslots = _snap_chars_ + (top - _id_( _lim_inf ));
+  return h;
+}
+
+static struct snapshot_slot *snapshot_slot (struct snapshot_blob *b, int id)
+{
+  struct snapshot_slot *t;
+
+  if (id > 0 && id < _snap_chars_)
+    t = &b->slot[id];
+  else if (id > _id_( _lim_inf ) && id < _id_( _lim_sup ) &&
+           (uint32_t) (id - _id_( _lim_inf )) < b->nslots - _snap_chars_ + 1)
+    t = &b->slot[_snap_chars_ + id - _id_( _lim_inf ) - 1];
+  else
+    return NULL;
+
+  return t->kind == _snap_alias ? &b->slot[t->off] : t;
+}
+
+struct getopt_map_snapshot *getopt_map_snapshot_new (char *short_opts, struct option *long_opts,
+                                                     struct option_map *m)
+{
+  struct getopt_map_snapshot *s;
+  uint32_t nslots, hash = snapshot_tables (short_opts, long_opts, m, &nslots);
+  size_t size = sizeof (struct snapshot_blob) + nslots * sizeof (struct snapshot_slot);
+
+  if ((s = malloc (sizeof (*s))) == NULL)
+    return NULL;
+  if ((s->b = calloc (1, size)) == NULL) {
+    free (s);
+    return NULL;
+  }
+  s->cap = s->len = size;
+  s->b->magic   = _snap_magic_;
+  s->b->version = _snap_version_;
+  s->b->hash    = hash;
+  s->b->nslots  = nslots;
+  s->b->size    = size;
+
+  // Short chars with a long equivalent share the slot of the long option
+  for ( ; m && (m->id || m->ch || m->msg) ; m++)
+    if (m->ch && m->id > _id_( _lim_inf ) && m->id < _id_( _lim_sup )) {
+      s->b->slot[(unsigned char) m->ch].kind = _snap_alias;
+      s->b->slot[(unsigned char) m->ch].off  = snapshot_slot (s->b, m->id) - s->b->slot;
+    }
+  return s;
+}
+
+// Slot of <id> about to take a new value. A string it held is given
+// back to the pool when it is the last one there.
+static struct snapshot_slot *snapshot_seen (struct getopt_map_snapshot *s, int id)
+{
+  struct snapshot_slot *t;
+
+  if (s == 0 || s->cap == 0 || (t = snapshot_slot (s->b, id)) == NULL)
+    return NULL;
+
+  if (t->kind == _snap_string && t->off + t->v.l == s->b->size)
+    s->b->size = t->off;
+  if (t->count < UINT16_MAX)
+    t->count++;
+  return t;
+}
+
+int getopt_map_snapshot_set (struct getopt_map_snapshot *s, int id, char *arg)
+{
+  struct snapshot_slot *t;
+  size_t n;
+
+  if (arg && s && s->cap && (t = snapshot_slot (s->b, id)) != NULL && t->kind == _snap_string &&
+      (size_t) t->v.l > strlen (arg)) {
+    // Overridden by a value that fits on the old one
+    strcpy ((char *) s->b + t->off, arg);
+    if (t->count < UINT16_MAX)
+      t->count++;
+    return 0;
+  }
+  if ((t = snapshot_seen (s, id)) == NULL)
+    return -1;
+
+  if (arg) {
+    n = strlen (arg) + 1;
+    if (s->b->size + n > s->cap) {
+      struct snapshot_blob *b;
+      size_t cap = s->cap * 2 + n;
+
+      if ((b = realloc (s->b, cap)) == NULL) {
+        t->kind = _snap_absent;
+        return -1;
+      }
+      t = (struct snapshot_slot *) ((char *) b + ((char *) t - (char *) s->b));
+      s->b = b;
+      s->cap = cap;
+    }
+    memcpy ((char *) s->b + s->b->size, arg, n);
+    t->kind = _snap_string;
+    t->off  = s->b->size;
+    t->v.l  = n;
+    s->b->size += n;
+  }
+  else {
+    t->kind = _snap_flag;
+    t->off  = 0;
+  }
+  return 0;
+}
+
+int getopt_map_snapshot_set_long (struct getopt_map_snapshot *s, int id, long val)
+{
+  struct snapshot_slot *t;
+
+  if ((t = snapshot_seen (s, id)) == NULL)
+    return -1;
+  t->kind = _snap_long;
+  t->off  = 0;
+  t->v.l  = val;
+  return 0;
+}
+
+int getopt_map_snapshot_set_double (struct getopt_map_snapshot *s, int id, double val)
+{
+  struct snapshot_slot *t;
+
+  if ((t = snapshot_seen (s, id)) == NULL)
+    return -1;
+  t->kind = _snap_double;
+  t->off  = 0;
+  t->v.d  = val;
+  return 0;
+}
+
+int getopt_map_snapshot_write (int fd, struct getopt_map_snapshot *s)
+{
+  const char *p;
+  size_t n;
+  ssize_t w;
+
+  if (s == 0)
+    return -1;
+
+  for (p = (const char *) s->b, n = s->b->size ; n ; p += w, n -= w)
+    if ((w = write (fd, p, n)) < 0) {
+      if (errno == EINTR)
+        w = 0;
+      else
+        return -1;
+    }
+  return 0;
+}
+
+struct getopt_map_snapshot *getopt_map_snapshot_attach (int fd, char *short_opts, struct option *long_opts,
+                                                        struct option_map *m)
+{
+  struct getopt_map_snapshot *s;
+  struct snapshot_blob *b;
+  struct stat st;
+  uint32_t nslots, hash = snapshot_tables (short_opts, long_opts, m, &nslots), i;
+  size_t size = sizeof (struct snapshot_blob) + nslots * sizeof (struct snapshot_slot);
+
+  if (fstat (fd, &st) < 0 || (size_t) st.st_size < size)
+    return NULL;
+  if ((b = mmap (NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED)
+    return NULL;
+
+  // Same tables, sane bounds and nul terminated pool
+  if (b->magic != _snap_magic_ || b->version != _snap_version_ || b->hash != hash ||
+      b->nslots != nslots || b->size < size || b->size > (size_t) st.st_size ||
+      (b->size > size && ((char *) b)[b->size - 1] != '\0'))
+    goto fail;
+  for (i = 0 ; i < nslots ; i++)
+    if ((b->slot[i].kind == _snap_string && (b->slot[i].off < size || b->slot[i].off >= b->size)) ||
+        (b->slot[i].kind == _snap_alias  && (b->slot[i].off >= nslots || b->slot[b->slot[i].off].kind == _snap_alias)))
+      goto fail;
+
+  if ((s = malloc (sizeof (*s))) == NULL)
+    goto fail;
+  s->b   = b;
+  s->cap = 0;
+  s->len = st.st_size;
+  return s;
+
+fail:
+  munmap (b, st.st_size);
+  return NULL;
+}
+
+int getopt_map_snapshot_has (struct getopt_map_snapshot *s, int id)
+{
+  struct snapshot_slot *t;
+
+  if (s == 0 || (t = snapshot_slot (s->b, id)) == NULL)
+    return 0;
+  return t->count;
+}
+
+char *getopt_map_snapshot_get (struct getopt_map_snapshot *s, int id)
+{
+  struct snapshot_slot *t;
+
+  if (s == 0 || (t = snapshot_slot (s->b, id)) == NULL || t->kind != _snap_string)
+    return NULL;
+  return (char *) s->b + t->off;
+}
+
+long getopt_map_snapshot_get_long (struct getopt_map_snapshot *s, int id, long dflt)
+{
+  struct snapshot_slot *t;
+
+  if (s == 0 || (t = snapshot_slot (s->b, id)) == NULL || t->kind != _snap_long)
+    return dflt;
+  return t->v.l;
+}
+
+double getopt_map_snapshot_get_double (struct getopt_map_snapshot *s, int id, double dflt)
+{
+  struct snapshot_slot *t;
+
+  if (s == 0 || (t = snapshot_slot (s->b, id)) == NULL || t->kind != _snap_double)
+    return dflt;
+  return t->v.d;
+}
+
+void getopt_map_snapshot_free (struct getopt_map_snapshot *s)
+{
+  if (s == 0)
+    return;
+  if (s->cap)
+    free (s->b);
+  else
+    munmap (s->b, s->len);
+  free (s);
+}
+#endif /* GETOPT_MAP_SNAPSHOT */
 #endif /* GETOPT_MAP_EXTENSIONS */
 
 #ifdef __cplusplus
@@ -167,6 +167,8 @@ enum option_map_id {
 #define _opt_zero_              {0, 0, 0, 0}  // bound mark sentinel - obligatory
 #define _opt_default_header_
 #define _opt_default_footer_    _opt_zero_
+#define _opt_list_(x,is_needed)      _opt_(x,is_needed),      // Elements of option lists (see
+#define _oph_list_(x,str,is_needed)  _oph_(x,str,is_needed),  // _opt_pool_ below)
 
 /** Mapped options **
  */
@@ -185,33 +187,176 @@ struct option_map {
 #define _opt_map_(x,y,arg)       { _id_(x), y, arg }
 #define _opt_map_zero_           {0, 0, 0}
 #endif
+#define _opt_map_list_(x,y,arg)  _opt_map_(x,y,arg),
 #define _opt_map_default_header_
 #ifndef GETOPT_MAP_EXTENSIONS
 #define _opt_map_default_footer_ _opt_map_( _lim_sup, 0, "" ),                                        \
                                  _opt_map_zero_
 #else
-#define _opt_map_default_footer_ _opt_map_( _lim_sup, 0, "" ),                                        \
-                                 _opt_map_( _app_header, 0, "Usage: %s [options] <file> ([*] = optional, <*> = obligatory)\nWhere [options] are the following:\n"), \
-                                 _opt_map_( _app_footer, 0, "See the application manual for a more detailed analyse of usage.\n"), \
-                                 _opt_map_( _app_error, 0, ""),                                       \
-                                 _opt_map_( _app_warning, 0, ""),                                     \
-                                 _opt_map_( _app_info, 0, ""),                                        \
-                                 _opt_map_( _app_question, 0, ""),                                    \
-                                 _opt_map_( _app_support, 0, "Please, file a ticket for support.\n"), \
+#define _opt_map_default_messages_(_opt_map_)                                                        \
+                                 _opt_map_( _lim_sup, 0, "" )                                         \
+                                 _opt_map_( _app_header, 0, "Usage: %s [options] <file> ([*] = optional, <*> = obligatory)\nWhere [options] are the following:\n") \
+                                 _opt_map_( _app_footer, 0, "See the application manual for a more detailed analyse of usage.\n") \
+                                 _opt_map_( _app_error, 0, "")                                        \
+                                 _opt_map_( _app_warning, 0, "")                                      \
+                                 _opt_map_( _app_info, 0, "")                                         \
+                                 _opt_map_( _app_question, 0, "")                                     \
+                                 _opt_map_( _app_support, 0, "Please, file a ticket for support.\n")  \
                                                                                                       \
-                                 _opt_map_( _opt_unknown, 0, "Unknown option"),                       \
-                                 _opt_map_( _opt_missing, 0, "Missing obligatory option"),            \
-                                 _opt_map_( _opt_uninitialized, 0, "Uninitialized option"),           \
-                                 _opt_map_( _opt_unhandled, 0, "Unhandled option"),                   \
-                                 _opt_map_( _opt_iteration, 0, "Options iteration"),                  \
+                                 _opt_map_( _opt_unknown, 0, "Unknown option")                        \
+                                 _opt_map_( _opt_missing, 0, "Missing obligatory option")             \
+                                 _opt_map_( _opt_uninitialized, 0, "Uninitialized option")            \
+                                 _opt_map_( _opt_unhandled, 0, "Unhandled option")                    \
+                                 _opt_map_( _opt_iteration, 0, "Options iteration")                   \
                                                                                                       \
-                                 _opt_map_( _arg_obligatory, 0, "<value>"),                           \
-                                 _opt_map_( _arg_optional, 0, "[value]"),                             \
-                                 _opt_map_( _arg_missing, 0, "Missing argument to"),                  \
-                                 _opt_map_( _arg_invalid, 0, "Invalid argument to"),                  \
+                                 _opt_map_( _arg_obligatory, 0, "<value>")                            \
+                                 _opt_map_( _arg_optional, 0, "[value]")                              \
+                                 _opt_map_( _arg_missing, 0, "Missing argument to")                   \
+                                 _opt_map_( _arg_invalid, 0, "Invalid argument to")
+#define _opt_map_default_footer_ _opt_map_default_messages_( _opt_map_list_ )                         \
                                  _opt_map_zero_
 #endif
 
+#ifdef GETOPT_MAP_EXTENSIONS
+/** Pooled options **
+ * Relocation free form of the option and option_map tables. Every entry
+ * is a record holding its id, char, argument type and the text itself
+ * (option name or message) inline, and the records are packed one after
+ * the other on a single const object. Nothing on it is a pointer, so no
+ * dynamic relocation is needed on PIE or shared library builds and the
+ * whole set stays on read only pages shared by every process.
+ *
+ * The tables are written once, as lists of the usual _opt_, _oph_ and
+ * _opt_map_ entries (no commas between them):
+ *
+ * #define app_opts(_opt_, _oph_)                  \
+ *     _opt_( str_j1, is_needed )                  \
+ *     ..                                          \
+ *     _oph_( str_jn, "str-jn", is_needed )
+ *
+ * #define app_maps(_opt_map_)                     \
+ *     _opt_map_( _zero, chr_i1, msg )             \
+ *     ..                                          \
+ *     _opt_map_( str_jn, 0, msg )
+ *
+ * static _opt_pool_( app_pool, app_opts, app_maps );
+ *
+ * and, if the classic tables are still wanted (not needed to call
+ * getopt_long, see getopt_pool_options):
+ *
+ * struct option app_long_opts[] = {
+ *     _opt_default_header_ app_opts( _opt_list_, _oph_list_ ) _opt_default_footer_
+ * };
+ *
+ * The default messages (_opt_map_default_footer_) are appended to the
+ * pool automatically. The pool is handed to the functions below through
+ * _pool_( app_pool ).
+ *
+ * getopt_pool_options returns a malloc'd struct option vector for
+ * getopt_long, with the names pointing into the pool. The caller must
+ * free it (the pool itself is never written nor freed).
+ *
+ * >> Obs: an id may have at most one _oph_ (records are named after
+ *         their ids) and _opt_pool_ is C only (anonymous structs are
+ *         declared inside sizeof).
+ */
+struct option_pool {
+    int            id;
+    unsigned int   size;     // Bytes up to the next record
+    char           kind;
+    char           ch;       // Mapping id <-> ch
+    char           has_arg;
+    char           hidden;   // _opt_map_ with msg 0
+    char           str[];    // Long option name or message
+};
+
+enum option_pool_kind {
+    _pool_end = 0,
+    _pool_opt,
+    _pool_map
+};
+
+#define _pool_rec_(txt)                  struct { int id; unsigned int size; char kind, ch, has_arg, hidden; \
+                                                  char str[sizeof (txt)]; }
+#define _pool_opt_rec_(x,is_needed)      _pool_rec_( _stringify_(x) ) _pool_opt_##x;
+#define _pool_oph_rec_(x,str,is_needed)  _pool_rec_( str ) _pool_oph_##x;
+#define _pool_map_rec_(x,y,msg)          _pool_rec_( msg ) _pool_map_rec_n_( __COUNTER__ );
+#define _pool_map_rec_n_(n)              _pool_map_rec_c_( n )
+#define _pool_map_rec_c_(n)              _pool_map_##n
+#define _pool_opt_ini_(x,is_needed)      { _id_(x), sizeof (_pool_rec_( _stringify_(x) )), _pool_opt, 0,          \
+                                           _##is_needed##_argument, 0, { _stringify_(x) } },
+#define _pool_oph_ini_(x,str,is_needed)  { _id_(x), sizeof (_pool_rec_( str )), _pool_opt, 0,                     \
+                                           _##is_needed##_argument, 0, { str } },
+#define _pool_map_ini_(x,y,msg)          { _id_(x), sizeof (_pool_rec_( msg )), _pool_map, y, 0, !(msg), { msg } },
+
+#define _opt_pool_(name,opts,maps)       const struct {                                                         \
+                                             opts( _pool_opt_rec_, _pool_oph_rec_ )                             \
+                                             maps( _pool_map_rec_ )                                             \
+                                             _opt_map_default_messages_( _pool_map_rec_ )                       \
+                                             _pool_rec_( "" ) _pool_end_;                                       \
+                                         } name = {                                                             \
+                                             opts( _pool_opt_ini_, _pool_oph_ini_ )                             \
+                                             maps( _pool_map_ini_ )                                             \
+                                             _opt_map_default_messages_( _pool_map_ini_ )                       \
+                                             { 0, sizeof (_pool_rec_( "" )), _pool_end, 0, 0, 0, { "" } }       \
+                                         }
+#define _pool_(name)                     ((const struct option_pool *) &(name))
+#define _pool_next_(p)                   ((const struct option_pool *) ((const char *) (p) + (p)->size))
+#endif /* GETOPT_MAP_EXTENSIONS */
+
+#ifdef GETOPT_MAP_EXTENSIONS
+/** Deferred handlers **
+ * Instead of doing the work on each 'case _id_( x ):' as soon as the
+ * option is seen, getopt_deferred first runs getopt_long over the whole
+ * argv keeping only the last value of each option (short chars mapped on
+ * <maps> are folded into their long option _id_). Only when all of them
+ * were accepted the handlers of the options seen are called, once each,
+ * with the option id, its final argument and <data>. Options overridden
+ * by a later occurrence or never given do no work at all.
+ *
+ * Handlers run after the ones listed on their <after> ids (up to
+ * GETOPT_HANDLER_DEPS), and otherwise in the order they are declared:
+ *
+ * struct option_handler app_handlers[] = {
+ *     _opt_handler_default_header_
+ *
+ *     _opt_handler_( str_k1, fn_k1 ),
+ *     _opt_handler_( str_k2, fn_k2, _id_( str_k1 ) ),  // k1 is handled first
+ *     _chr_handler_( chr_i1, fn_i1 ),                   // Short only options
+ *
+ *     _opt_handler_default_footer_
+ * };
+ *
+ * getopt_deferred returns 0 when all handlers returned 0. Otherwise it
+ * returns the first non zero handler return and stores the id of that
+ * handler on *<failed> (when not NULL, it is 0 in every other case).
+ * Before any handler runs it stops, with optopt, optind and optarg as
+ * left by getopt_long, returning:
+ *   '?' or ':'             unknown option or missing argument;
+ *   1                      argument iteration ('-' on <short_opts>);
+ *   opt                    an option with no handler (e.g. _id_( help ));
+ *   GETOPT_DEFERRED_CYCLE  a dependency cycle among the handlers;
+ *   GETOPT_DEFERRED_ERROR  no handler table or out of memory.
+ * Options stored through struct option flag (getopt_long returns 0)
+ * are left to getopt_long.
+ */
+#define GETOPT_HANDLER_DEPS     4
+#define GETOPT_DEFERRED_ERROR   INT_MIN
+#define GETOPT_DEFERRED_CYCLE   (INT_MIN + 1)
+
+struct option_handler {
+    int   id;
+    int (*fn) (int id, char *arg, void *data);
+    int   after[GETOPT_HANDLER_DEPS];   // Ids that must be handled before
+};
+
+#define _opt_handler_(x,fn,after...)  { _id_(x), fn, { after } }
+#define _chr_handler_(y,fn,after...)  { y, fn, { after } }
+#define _opt_handler_zero_            { 0, 0, { 0 } }  // bound mark sentinel - obligatory
+#define _opt_handler_default_header_
+#define _opt_handler_default_footer_  _opt_handler_zero_
+#endif /* GETOPT_MAP_EXTENSIONS */
+
 struct option *     option_p (struct option *opts, int id);
 #ifdef GETOPT_MAP_EXTENSIONS
 struct option_map * option_map_p (struct option_map *maps, int id);
@@ -221,6 +366,18 @@ char * getopt_msg (struct option_map *maps, int id);
 void   getopt_usage (char *app_name, char *app_version, char *app_license,
                      char *short_opts, struct option *long_opts,
                      struct option_map *opts_maps, int exit_val);
+
+const struct option_pool * option_pool_p (const struct option_pool *pool, int kind, int id);
+
+int            getopt_pool_map (const struct option_pool *pool, int id);
+const char *   getopt_pool_msg (const struct option_pool *pool, int id);
+struct option *getopt_pool_options (const struct option_pool *pool);
+void           getopt_pool_usage (char *app_name, char *app_version, char *app_license,
+                                  char *short_opts, const struct option_pool *pool, int exit_val);
+
+int    getopt_deferred (int ac, char *av[], char *short_opts, struct option *long_opts,
+                        struct option_map *maps, struct option_handler *handlers, void *data,
+                        int *failed);
 #ifdef GETOPT_FILE_TRANSLATIONS
 extern struct option opt_zero;
 extern struct option_map opt_map_zero;
@@ -228,6 +385,57 @@ extern struct option_map opt_map_zero;
 int    getopt_map_write (FILE *f, struct option_map *msgs);
 int    getopt_map_read  (FILE *f, struct option_map *msgs);
 #endif
+#ifdef GETOPT_MAP_SNAPSHOT
+/** Parse snapshot **
+ * A completed parse stored as a position independent blob (no pointers,
+ * only offsets): one slot per short option char and per long option id,
+ * followed by a string pool with the arguments. Arguments may also be
+ * stored already converted to long or double by the master, so workers
+ * do not need to parse numbers either. The master records the
+ * options while parsing and writes the blob to a file descriptor (e.g. a
+ * memfd or an unlinked tmpfile) inherited by its workers, which attach to
+ * it with mmap and read the values by _id_ in O(1), without parsing.
+ *
+ * Short option chars mapped to a long option on <maps> are folded into
+ * the _id_ of the long option, i.e., '-o' and '--optional' share a slot.
+ *
+ * The blob carries a hash of <short_opts>, <long_opts> and the id/char
+ * pairs of <maps> (messages are left out so translations do not matter).
+ * Attaching with different tables fails.
+ *
+ *   s = getopt_map_snapshot_new (short_opts, long_opts, opts_maps);
+ *   while ((opt = getopt_long (...)) != -1) {
+ *     ..
+ *     getopt_map_snapshot_set (s, opt, optarg);       // or, e.g.:
+ *     getopt_map_snapshot_set_long (s, opt, strtol (optarg, 0, 10));
+ *   }
+ *   getopt_map_snapshot_write (fd, s);   // master
+ *   ..
+ *   s = getopt_map_snapshot_attach (fd, short_opts, long_opts, opts_maps);
+ *   if (getopt_map_snapshot_has (s, _id_( optional )))
+ *     arg = getopt_map_snapshot_get (s, _id_( optional ));
+ *   n = getopt_map_snapshot_get_long (s, _id_( workers ), 2);   // 2 if unset
+ *
+ * The getters return NULL (or the given default) when the option was not
+ * seen, was seen without argument or was stored with another type. A
+ * repeated option keeps only its last value.
+ */
+struct getopt_map_snapshot;
+
+struct getopt_map_snapshot * getopt_map_snapshot_new (char *short_opts, struct option *long_opts,
+                                                      struct option_map *maps);
+struct getopt_map_snapshot * getopt_map_snapshot_attach (int fd, char *short_opts, struct option *long_opts,
+                                                         struct option_map *maps);
+int    getopt_map_snapshot_set   (struct getopt_map_snapshot *s, int id, char *arg);
+int    getopt_map_snapshot_set_long   (struct getopt_map_snapshot *s, int id, long val);
+int    getopt_map_snapshot_set_double (struct getopt_map_snapshot *s, int id, double val);
+int    getopt_map_snapshot_write (int fd, struct getopt_map_snapshot *s);
+int    getopt_map_snapshot_has   (struct getopt_map_snapshot *s, int id);
+char * getopt_map_snapshot_get   (struct getopt_map_snapshot *s, int id);
+long   getopt_map_snapshot_get_long   (struct getopt_map_snapshot *s, int id, long dflt);
+double getopt_map_snapshot_get_double (struct getopt_map_snapshot *s, int id, double dflt);
+void   getopt_map_snapshot_free  (struct getopt_map_snapshot *s);
+#endif /* GETOPT_MAP_SNAPSHOT */
 #endif /* GETOPT_MAP_EXTENSIONS */
 
 #ifdef __cplusplus